@@ -4,61 +4,75 @@
 #include <memory.h>
 #include "file_reader.h"
 
-int* fat_read(volume_t* volume, uint32_t first_sector){
-    uint8_t *fat1_data = (uint8_t *) malloc(volume->super_sector->bytes_per_sector * volume->super_sector->sectors_per_fat);
-    if(!fat1_data){
-        errno = ENOMEM;
+uint16_t* fat_read(volume_t* volume, const fat_super_t* super_sector, uint32_t first_sector){
+    uint32_t fat_bytes = super_sector->bytes_per_sector * super_sector->sectors_per_fat;
+    uint32_t number_of_entries = volume->number_of_clusters + 2;
+    if(((uint64_t)number_of_entries * 3 + 1) / 2 > fat_bytes){
+        errno = EINVAL;
         return NULL;
     }
-    uint8_t *fat2_data = (uint8_t *) malloc(volume->super_sector->bytes_per_sector * volume->super_sector->sectors_per_fat);
-    if(!fat2_data){
-        free(fat1_data);
+    uint8_t *fat1_data = (uint8_t *) malloc(fat_bytes);
+    if(!fat1_data){
         errno = ENOMEM;
         return NULL;
     }
-    uint32_t sectors_per_root_dir = (volume->super_sector->root_dir_capacity * FAT_SFN_SIZE / volume->super_sector->bytes_per_sector);
-    uint32_t volume_size = volume->super_sector->logical_sectors16 == 0 ? volume->super_sector->logical_sectors32 : volume->super_sector->logical_sectors16;
-    uint32_t user_size = volume_size - (volume->super_sector->fat_count * volume->super_sector->sectors_per_fat) - volume->super_sector->reserved_sectors - sectors_per_root_dir;
-    uint32_t number_of_cluster_per_volume = user_size / volume->super_sector->sectors_per_cluster;
-
-    uint32_t fat1_position = first_sector + volume->super_sector->reserved_sectors;
-    uint32_t  fat2_position = fat1_position + volume->super_sector->sectors_per_fat;
-    int r1 = disk_read(volume->disk, fat1_position, fat1_data, volume->super_sector->sectors_per_fat);
-    if(r1 != volume->super_sector->sectors_per_fat){
+    uint32_t fat1_position = first_sector + super_sector->reserved_sectors;
+    int r1 = disk_read(volume->disk, fat1_position, fat1_data, super_sector->sectors_per_fat);
+    if(r1 != super_sector->sectors_per_fat){
         free(fat1_data);
-        free(fat2_data);
         errno = EINVAL;
         return NULL;
     }
-    int r2 = disk_read(volume->disk, fat2_position, fat2_data, volume->super_sector->sectors_per_fat);
-    if(r2 != volume->super_sector->sectors_per_fat){
-        free(fat1_data);
+    if(super_sector->fat_count == 2){
+        uint8_t *fat2_data = (uint8_t *) malloc(fat_bytes);
+        if(!fat2_data){
+            free(fat1_data);
+            errno = ENOMEM;
+            return NULL;
+        }
+        uint32_t fat2_position = fat1_position + super_sector->sectors_per_fat;
+        int r2 = disk_read(volume->disk, fat2_position, fat2_data, super_sector->sectors_per_fat);
+        if(r2 != super_sector->sectors_per_fat || memcmp(fat1_data, fat2_data, fat_bytes) != 0){
+            free(fat1_data);
+            free(fat2_data);
+            errno = EINVAL;
+            return NULL;
+        }
         free(fat2_data);
-        errno = EINVAL;
-        return NULL;
     }
-    if(memcmp(fat1_data, fat2_data, volume->super_sector->bytes_per_sector * volume->super_sector->sectors_per_fat) != 0){
+    uint16_t *buffer = (uint16_t *) malloc(number_of_entries * sizeof(uint16_t));
+    if(!buffer){
         free(fat1_data);
-        free(fat2_data);
-        errno = EINVAL;
+        errno = ENOMEM;
         return NULL;
     }
-    free(fat2_data);
-    int *buffer = malloc((number_of_cluster_per_volume + 2) * sizeof(int));
-    for(uint32_t i = 0, j = 0; i < number_of_cluster_per_volume + 2; i += 2, j += 3){
-        uint8_t b1 = fat1_data[j];
-        uint8_t b2 = fat1_data[j + 1];
-        uint8_t b3 = fat1_data[j + 2];
-
-        int c1 = ((b2 & 0x0F) << 8) | b1;
-        int c2 = ((b2 & 0xF0) >> 4) | (b3 << 4);
-        buffer[i] = c1;
-        buffer[i + 1] = c2;
+    for(uint32_t i = 0; i < number_of_entries; i++){
+        uint32_t j = i + i / 2;
+        if(i % 2 == 0)
+            buffer[i] = ((fat1_data[j + 1] & 0x0F) << 8) | fat1_data[j];
+        else
+            buffer[i] = ((fat1_data[j] & 0xF0) >> 4) | (fat1_data[j + 1] << 4);
     }
     free(fat1_data);
     return buffer;
 }
 
+fat_sfn_t* root_dir_read(volume_t* volume){
+    uint32_t sectors_per_root_dir = volume->data_position - volume->root_dir_position;
+    fat_sfn_t* root_dir = (fat_sfn_t*)malloc(sectors_per_root_dir * BYTES_PER_SECTOR);
+    if(!root_dir){
+        errno = ENOMEM;
+        return NULL;
+    }
+    int count = disk_read(volume->disk, volume->root_dir_position, root_dir, sectors_per_root_dir);
+    if(count != (int)sectors_per_root_dir){
+        free(root_dir);
+        errno = EINVAL;
+        return NULL;
+    }
+    return root_dir;
+}
+
 void convert_name(const char* name, const char* extension, char* output){
     int name_counter = 0; int extension_counter = 0;
     for(int i = 0; i < 8; i++){
@@ -101,23 +115,8 @@ void convert_directory(const char* name, char* output){
 }
 
 fat_sfn_t* find_file(volume_t * volume, const char* file_name){
-    fat_sfn_t* fat_sfn = (fat_sfn_t*)malloc(FAT_SFN_SIZE);
-    if(!fat_sfn){
-        errno = ENOMEM;
-        return NULL;
-    }
-    fseek(volume->disk->file, ((volume->super_sector->fat_count * volume->super_sector->sectors_per_fat + volume->super_sector->reserved_sectors) * BYTES_PER_SECTOR), SEEK_SET);
-    uint32_t sectors_per_root_dir = (volume->super_sector->root_dir_capacity * FAT_SFN_SIZE / volume->super_sector->bytes_per_sector);
-    uint32_t volume_size = volume->super_sector->logical_sectors16 == 0 ? volume->super_sector->logical_sectors32 : volume->super_sector->logical_sectors16;
-    uint32_t user_size = volume_size - (volume->super_sector->fat_count * volume->super_sector->sectors_per_fat) - volume->super_sector->reserved_sectors - sectors_per_root_dir;
-    uint32_t number_of_cluster_per_volume = user_size / volume->super_sector->sectors_per_cluster;
-    for(uint32_t i = 0; i < number_of_cluster_per_volume + 2; i++){
-        unsigned int count = fread(fat_sfn, FAT_SFN_SIZE, 1, volume->disk->file);
-        if(count != 1){
-            free(fat_sfn);
-            errno = EINVAL;
-            return NULL;
-        }
+    for(uint32_t i = 0; i < volume->root_dir_capacity; i++){
+        fat_sfn_t* fat_sfn = &volume->root_dir[i];
         char converted[13];
         convert_name(fat_sfn->name, fat_sfn->extension, converted);
         int check = memcmp(converted, file_name, strlen(file_name));
@@ -125,7 +124,6 @@ fat_sfn_t* find_file(volume_t * volume, const char* file_name){
             return fat_sfn;
         }
     }
-    free(fat_sfn);
     errno = EINVAL;
     return NULL;
 }
@@ -135,7 +133,7 @@ int read_bytes(volume_t * volume, void* buffer, int32_t first_sector, uint32_t o
         errno = EFAULT;
         return -1;
     }
-    uint32_t cluster_size = volume->super_sector->sectors_per_cluster * BYTES_PER_SECTOR;
+    uint32_t cluster_size = volume->cluster_size;
     size_t read_size = (bytes_to_read == cluster_size ? bytes_to_read : bytes_to_read + (cluster_size - (bytes_to_read % cluster_size))) / BYTES_PER_SECTOR;
     uint8_t* temp_buffer = (uint8_t*)malloc(read_size * BYTES_PER_SECTOR);
     if(!temp_buffer){
@@ -214,38 +212,53 @@ volume_t* fat_open(disk_t* pdisk, uint32_t first_sector){
         errno = EFAULT;
         return NULL;
     }
-   volume_t* volume = (volume_t*)malloc(VOLUME_SIZE);
-    if(!volume){
-        errno = ENOMEM;
+    fat_super_t super_sector;
+    if(disk_read(pdisk, first_sector, &super_sector, 1) != 1){
+        errno = EINVAL;
         return NULL;
     }
-    fat_super_t* super_sector = (fat_super_t*)malloc(FAT_SUPER_SIZE);
-    if(!super_sector){
-        free(volume);
-        errno = ENOMEM;
+    if(super_sector.bytes_per_sector != BYTES_PER_SECTOR || (super_sector.fat_count != 1 && super_sector.fat_count != 2) || super_sector.sectors_per_cluster == 0){
+        errno = EINVAL;
         return NULL;
     }
-    if(disk_read(pdisk, first_sector, super_sector, 1) != 1){
-        free(super_sector);
-        free(volume);
+    uint32_t root_dir_position = first_sector + super_sector.reserved_sectors + super_sector.fat_count * super_sector.sectors_per_fat;
+    uint32_t sectors_per_root_dir = (super_sector.root_dir_capacity * FAT_SFN_SIZE + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR;
+    uint32_t volume_size = super_sector.logical_sectors16 == 0 ? super_sector.logical_sectors32 : super_sector.logical_sectors16;
+    uint32_t system_size = root_dir_position - first_sector + sectors_per_root_dir;
+    if(volume_size <= system_size){
         errno = EINVAL;
         return NULL;
     }
-    if(super_sector->bytes_per_sector != BYTES_PER_SECTOR || (super_sector->fat_count != 1 && super_sector->fat_count != 2)){
-        free(super_sector);
-        free(volume);
+    uint32_t number_of_clusters = (volume_size - system_size) / super_sector.sectors_per_cluster;
+    if(number_of_clusters > FAT12_MAX_CLUSTERS){
         errno = EINVAL;
         return NULL;
     }
+    volume_t* volume = (volume_t*)malloc(VOLUME_SIZE);
+    if(!volume){
+        errno = ENOMEM;
+        return NULL;
+    }
     volume->disk = pdisk;
-    volume->super_sector = super_sector;
-    int* fat_array = fat_read(volume, first_sector);
+    volume->root_dir_position = root_dir_position;
+    volume->data_position = root_dir_position + sectors_per_root_dir;
+    volume->sectors_per_cluster = super_sector.sectors_per_cluster;
+    volume->cluster_size = super_sector.sectors_per_cluster * BYTES_PER_SECTOR;
+    volume->number_of_clusters = number_of_clusters;
+    volume->root_dir_capacity = super_sector.root_dir_capacity;
+    uint16_t* fat_array = fat_read(volume, &super_sector, first_sector);
     if(!fat_array){
-        free(volume->super_sector);
         free(volume);
         return NULL;
     }
     volume->fat_array = fat_array;
+    fat_sfn_t* root_dir = root_dir_read(volume);
+    if(!root_dir){
+        free(volume->fat_array);
+        free(volume);
+        return NULL;
+    }
+    volume->root_dir = root_dir;
     return volume;
 }
 
@@ -254,8 +267,8 @@ int fat_close(volume_t* pvolume){
         errno = EFAULT;
         return -1;
     }
+    free(pvolume->root_dir);
     free(pvolume->fat_array);
-    free(pvolume->super_sector);
     free(pvolume);
     return 0;
 }
@@ -284,7 +297,6 @@ file_t* file_open(volume_t* pvolume, const char* file_name){
 int file_close(file_t* stream){
     if(!stream)
         return 1;
-    free(stream->fat_sfn);
     free(stream);
     return 0;
 }
@@ -297,18 +309,24 @@ size_t file_read(void *ptr, size_t size, size_t nmemb, file_t *stream){
     size_t true_size = size * nmemb;
     if(stream->offset == stream->fat_sfn->file_size && true_size > 0)
         return 0;
-    int* fat_array = stream->volume->fat_array;
-    int index = stream->fat_sfn->low_cluster_index;
-    uint32_t root_dir = stream->volume->super_sector->fat_count * stream->volume->super_sector->sectors_per_fat + stream->volume->super_sector->reserved_sectors;
-    uint32_t data_block = root_dir + (stream->volume->super_sector->root_dir_capacity * FAT_SFN_SIZE) / BYTES_PER_SECTOR;
-    int check; size_t cluster_size = stream->volume->super_sector->sectors_per_cluster * BYTES_PER_SECTOR;
+    if(true_size == 0 || stream->fat_sfn->file_size == 0)
+        return 0;
+    uint16_t* fat_array = stream->volume->fat_array;
+    uint32_t index = stream->fat_sfn->low_cluster_index;
+    uint32_t data_block = stream->volume->data_position;
+    int check; size_t cluster_size = stream->volume->cluster_size;
     size_t file_size = stream->fat_sfn->file_size; size_t read_size;
     size_t _used_size; size_t _data_size;
     size_t counter = 0; size_t _offset = stream->offset;
     uint8_t* temp_buffer = (uint8_t *)malloc(cluster_size);
     boolean stop = FALSE;
     while(TRUE) {
-        uint32_t cur_data = data_block + (index - 2) * stream->volume->super_sector->sectors_per_cluster;
+        if (index < 2 || index >= stream->volume->number_of_clusters + 2) {
+            free(temp_buffer);
+            errno = ERANGE;
+            return -1;
+        }
+        uint32_t cur_data = data_block + (index - 2) * stream->volume->sectors_per_cluster;
         _data_size = file_size > cluster_size ? cluster_size : file_size;
         _used_size = _data_size > true_size ? true_size : _data_size;
         if (_offset < cluster_size) {
@@ -343,8 +361,13 @@ size_t file_read(void *ptr, size_t size, size_t nmemb, file_t *stream){
         if (file_size == 0 || true_size == 0) {
             break;
         }
-        int value = fat_array[index];
-        if (value > 0xFF8)
+        uint16_t value = fat_array[index];
+        if (value == FAT12_BAD_CLUSTER) {
+            free(temp_buffer);
+            errno = EIO;
+            return -1;
+        }
+        if (value >= FAT12_END_OF_CHAIN)
             break;
         index = value;
     }
@@ -396,31 +419,11 @@ dir_t* dir_open(volume_t* pvolume, const char* dir_path){
         errno = ENOMEM;
         return NULL;
     }
-    uint32_t root_dir_position = pvolume->super_sector->fat_count * pvolume->super_sector->sectors_per_fat + pvolume->super_sector->reserved_sectors;
-    uint32_t sectors_per_root_dir = (pvolume->super_sector->root_dir_capacity * FAT_SFN_SIZE / pvolume->super_sector->bytes_per_sector);
-    uint32_t volume_size = pvolume->super_sector->logical_sectors16 == 0 ? pvolume->super_sector->logical_sectors32 : pvolume->super_sector->logical_sectors16;
-    uint32_t user_size = volume_size - (pvolume->super_sector->fat_count * pvolume->super_sector->sectors_per_fat) - pvolume->super_sector->reserved_sectors - sectors_per_root_dir;
-    uint32_t number_of_cluster_per_volume = user_size / pvolume->super_sector->sectors_per_cluster;
-    size_t bytes_to_read = (number_of_cluster_per_volume + 2) * FAT_SFN_SIZE;
-    uint8_t* root_dir = (uint8_t*)malloc(bytes_to_read);
-    if(!root_dir){
-        free(dir);
-        errno = ENOMEM;
-        return NULL;
-    }
-    int check = read_bytes(pvolume, root_dir, root_dir_position, 0, bytes_to_read);
-    if(check == -1){
-        free(dir);
-        free(root_dir);
-        errno = ERANGE;
-        return NULL;
-    }
     dir->volume = pvolume;
     dir->offset = 0;
     dir->dir_path = dir_path;
-    dir->root_dir = root_dir;
-    dir->number_of_entries = pvolume->super_sector->root_dir_capacity;
-    dir->root_dir_position = root_dir_position;
+    dir->entries = pvolume->root_dir;
+    dir->number_of_entries = pvolume->root_dir_capacity;
     return dir;
 }
 
@@ -436,29 +439,15 @@ int dir_read(dir_t* pdir, dir_entry_t* pentry){
         return -1;
     }
     if(!memcmp(pdir->dir_path, ROOT_DIR_PATH, strlen(ROOT_DIR_PATH))){
-        fat_sfn_t* temp_buffer = (fat_sfn_t *)malloc(FAT_SFN_SIZE);
         boolean stop = FALSE;
         do {
-            if(pdir->offset == pdir->number_of_entries){
-                free(temp_buffer);
+            if(pdir->offset == pdir->number_of_entries)
                 return 1;
-            }
-            if (!temp_buffer) {
-                errno = ENOMEM;
-                return -1;
-            }
-            int check = read_bytes(pdir->volume, temp_buffer, pdir->root_dir_position, pdir->offset * FAT_SFN_SIZE, FAT_SFN_SIZE);
-            if (check != FAT_SFN_SIZE) {
-                free(temp_buffer);
-                errno = EIO;
-                return -1;
-            }
-            convert_entry(temp_buffer, pentry);
+            convert_entry(&pdir->entries[pdir->offset], pentry);
             pdir->offset++;
             if(pentry->name[0] != -27 && pentry->name[0] != '\0' && pentry->name[1] != '\b')
                 stop = TRUE;
         }while(!stop);
-        free(temp_buffer);
     }
     else{
         errno = EIO;
@@ -474,7 +463,6 @@ int dir_close(dir_t* pdir){
         errno = EFAULT;
         return -1;
     }
-    free(pdir->root_dir);
     free(pdir);
     return 0;
 }
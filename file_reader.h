@@ -50,9 +50,16 @@ typedef struct fat_super_t{
 #define FAT_SUPER_SIZE sizeof(fat_super_t)
 
 typedef struct volume_t{
-    fat_super_t* super_sector;
-    int* fat_array;
     disk_t *disk;
+    uint16_t* fat_array;
+    struct fat_sfn_t* root_dir;
+
+    uint32_t root_dir_position;
+    uint32_t data_position;
+    uint32_t cluster_size;
+    uint32_t number_of_clusters;
+    uint16_t root_dir_capacity;
+    uint8_t sectors_per_cluster;
 } __attribute__(( packed )) volume_t;
 
 #define VOLUME_SIZE sizeof(volume_t)
@@ -111,9 +118,8 @@ typedef struct dir_entry_t{
 typedef struct dir_t{
     uint32_t offset;
     uint32_t number_of_entries;
-    uint32_t root_dir_position;
 
-    uint8_t* root_dir;
+    fat_sfn_t* entries;
     const char* dir_path;
 
     volume_t* volume;
@@ -123,9 +129,13 @@ typedef struct dir_t{
 
 #define ROOT_DIR_PATH "\\"
 #define FAT12_DIRECTORY_MAX_CAPACITY 33554432
+#define FAT12_MAX_CLUSTERS 4084
+#define FAT12_BAD_CLUSTER 0xFF7
+#define FAT12_END_OF_CHAIN 0xFF8
 
 //MOJE FUNKCJE
-int* fat_read(volume_t* volume, uint32_t first_sector);
+uint16_t* fat_read(volume_t* volume, const fat_super_t* super_sector, uint32_t first_sector);
+fat_sfn_t* root_dir_read(volume_t* volume);
 
 void convert_name(const char* name, const char* extension, char* output);
 void convert_directory(const char* name, char* output);